@@ -0,0 +1,585 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <dirent.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "event_store.h"
+
+// Queries the event store written by event_store.
+// Build: gcc -o event_query event_query.c
+//
+// Only segments whose index can match the filters are read, e.g.
+//   ./event_query -p 2 -c policy2 -b -s 6h   Policy2 breaches for comm policy2 in the last 6 hours
+//   ./event_query -t 10                       top 10 processes by time above UPPER_LIMIT
+
+#define READ_BATCH 4096  // Records read per fread()
+
+struct query {
+    const char *dir;
+    int policy;             // -1 = any
+    int32_t pid;            // 0 = any
+    const char *comm;       // NULL = any
+    int64_t since;          // 0 = beginning of the store
+    int breaches_only;
+    int alerts_only;
+    long limit;             // 0 = no limit
+    int top;                // > 0 selects top-N mode
+    long upper_limit_kb;
+};
+
+struct segment {
+    int64_t id;
+    struct segment_index idx;
+};
+
+// Per-process accumulator for top-N mode, keyed by PID and comm
+struct process_time {
+    int32_t pid;
+    char comm[EVENT_COMM_LEN];
+    int64_t last_ts;
+    uint32_t last_iteration;
+    int last_above;
+    int64_t above_seconds;
+    int64_t max_rss_kb;
+};
+
+struct process_table {
+    struct process_time *slots;
+    size_t capacity;
+    size_t used;
+};
+
+long upper_limit_kb = 0;
+char store_dir[256] = "events";
+
+void read_config(const char *file) {
+    FILE *fp = fopen(file, "r");
+    if (fp == NULL) {
+        fprintf(stderr, "Could not open config file\n");
+        exit(EXIT_FAILURE);
+    }
+
+    char line[256];
+    while (fgets(line, sizeof(line), fp)) {
+        if (sscanf(line, "UPPER_LIMIT=%ld", &upper_limit_kb) == 1) {
+            continue;
+        }
+        if (sscanf(line, "EVENT_STORE_DIR=\"%255[^\"]\"", store_dir) == 1) {
+            continue;
+        }
+        if (sscanf(line, "EVENT_STORE_DIR=%255s", store_dir) == 1) {
+            continue;
+        }
+    }
+
+    fclose(fp);
+
+    if (upper_limit_kb <= 0) {
+        fprintf(stderr, "Invalid upper limit value in config file. It must be a positive integer.\n");
+        exit(EXIT_FAILURE);
+    }
+}
+
+void usage(const char *prog) {
+    fprintf(stderr,
+            "Usage: %s [-d store_dir] [-p policy] [-P pid] [-c comm] [-s duration]\n"
+            "          [-b] [-a] [-n limit] [-t N] [-f config]\n"
+            "  -p policy    only events of this policy (0 = plain RSS samples, 1-7)\n"
+            "  -P pid       only events of this PID\n"
+            "  -c comm      only events of this command name (first 15 characters)\n"
+            "  -s duration  only the last duration, e.g. 90s, 30m, 6h, 2d\n"
+            "  -b           only breaches (RSS above UPPER_LIMIT)\n"
+            "  -a           only events that were added to the alert email\n"
+            "  -n limit     print at most limit events\n"
+            "  -t N         top N processes by time spent above UPPER_LIMIT\n"
+            "               (only -d, -P, -c, -s and -f can be combined with -t)\n",
+            prog);
+    exit(EXIT_FAILURE);
+}
+
+// Parses a whole decimal number, returns 0 if text is not one
+int parse_number(const char *text, long *value) {
+    char *end;
+
+    errno = 0;
+    *value = strtol(text, &end, 10);
+    return end != text && *end == '\0' && errno == 0;
+}
+
+// Parses a duration such as 90, 90s, 30m, 6h or 2d, returns -1 if invalid
+int64_t parse_duration(const char *text) {
+    char *end;
+    int64_t unit;
+
+    errno = 0;
+    long long value = strtoll(text, &end, 10);
+    if (end == text || value < 0 || errno != 0) {
+        return -1;
+    }
+    switch (*end) {
+    case '\0':
+    case 's':
+        unit = 1;
+        break;
+    case 'm':
+        unit = 60;
+        break;
+    case 'h':
+        unit = 3600;
+        break;
+    case 'd':
+        unit = 86400;
+        break;
+    default:
+        return -1;
+    }
+    if (*end != '\0' && end[1] != '\0') {
+        return -1;
+    }
+    if (value > INT64_MAX / unit) {
+        return -1;
+    }
+    return value * unit;
+}
+
+int compare_segments(const void *a, const void *b) {
+    const struct segment *sa = a;
+    const struct segment *sb = b;
+    return (sa->id > sb->id) - (sa->id < sb->id);
+}
+
+// Loads every segment index in dir, sorted oldest first
+struct segment *load_segments(const char *dir, size_t *count) {
+    DIR *dp = opendir(dir);
+    if (dp == NULL) {
+        fprintf(stderr, "Could not open event store %s: %s\n", dir, strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+
+    struct segment *segments = NULL;
+    size_t capacity = 0;
+    struct dirent *entry;
+
+    *count = 0;
+    while ((entry = readdir(dp)) != NULL) {
+        long long id;
+        char ext[8];
+        if (sscanf(entry->d_name, "seg-%lld.%7s", &id, ext) != 2 || strcmp(ext, "idx") != 0) {
+            continue;
+        }
+
+        char path[4096];
+        struct segment_index idx;
+        event_segment_path(path, sizeof(path), dir, id, "idx");
+        FILE *fp = fopen(path, "rb");
+        if (fp == NULL) {
+            continue;
+        }
+        int ok = fread(&idx, sizeof(idx), 1, fp) == 1;
+        fclose(fp);
+        if (!ok || idx.magic != EVENT_STORE_MAGIC || idx.version != EVENT_STORE_VERSION) {
+            fprintf(stderr, "Skipping invalid segment index %s\n", path);
+            continue;
+        }
+
+        if (*count == capacity) {
+            capacity = capacity ? capacity * 2 : 64;
+            segments = realloc(segments, capacity * sizeof(*segments));
+            if (segments == NULL) {
+                fprintf(stderr, "Memory allocation failed\n");
+                exit(EXIT_FAILURE);
+            }
+        }
+        segments[*count].id = id;
+        segments[*count].idx = idx;
+        (*count)++;
+    }
+
+    closedir(dp);
+    qsort(segments, *count, sizeof(*segments), compare_segments);
+    return segments;
+}
+
+// Checks the filters that are shared by both query modes against a segment index
+int segment_may_match(const struct segment_index *idx, const struct query *q) {
+    if (idx->count == 0 || idx->last_ts < q->since) {
+        return 0;
+    }
+    if (q->pid != 0 && !event_filter_test(idx->pid_filter, event_pid_bit(q->pid))) {
+        return 0;
+    }
+    if (q->comm != NULL && !event_filter_test(idx->comm_filter, event_comm_bit(q->comm))) {
+        return 0;
+    }
+    return 1;
+}
+
+int event_matches(const struct event_record *ev, const struct query *q) {
+    if (ev->timestamp < q->since) {
+        return 0;
+    }
+    if (q->policy >= 0 && ev->policy != q->policy) {
+        return 0;
+    }
+    if (q->pid != 0 && ev->pid != q->pid) {
+        return 0;
+    }
+    if (q->comm != NULL && strncmp(ev->comm, q->comm, EVENT_COMM_LEN) != 0) {
+        return 0;
+    }
+    if (q->breaches_only && ev->rss_kb <= q->upper_limit_kb) {
+        return 0;
+    }
+    if (q->alerts_only && !(ev->flags & EVENT_FLAG_ALERT)) {
+        return 0;
+    }
+    return 1;
+}
+
+// Streams the records of one segment to callback until it returns 0
+int scan_segment(const char *dir, const struct segment *seg,
+                 int (*callback)(const struct event_record *, void *), void *arg) {
+    static struct event_record batch[READ_BATCH];
+    char path[4096];
+
+    event_segment_path(path, sizeof(path), dir, seg->id, "dat");
+    FILE *fp = fopen(path, "rb");
+    if (fp == NULL) {
+        fprintf(stderr, "Could not open segment %s: %s\n", path, strerror(errno));
+        return 1;
+    }
+
+    // Records past idx.count belong to an interrupted write and are ignored
+    uint64_t remaining = seg->idx.count;
+    while (remaining > 0) {
+        size_t want = remaining < READ_BATCH ? (size_t)remaining : READ_BATCH;
+        size_t got = fread(batch, sizeof(batch[0]), want, fp);
+        for (size_t i = 0; i < got; i++) {
+            if (!callback(&batch[i], arg)) {
+                fclose(fp);
+                return 0;
+            }
+        }
+        if (got < want) {
+            break;
+        }
+        remaining -= got;
+    }
+
+    fclose(fp);
+    return 1;
+}
+
+void print_event(const struct event_record *ev) {
+    char time_str[100];
+    time_t ts = (time_t)ev->timestamp;
+    struct tm *t = localtime(&ts);
+    strftime(time_str, sizeof(time_str) - 1, "%a %b %d %T %Z %Y", t);
+
+    char policy[16];
+    if (ev->policy == EVENT_POLICY_SAMPLE) {
+        snprintf(policy, sizeof(policy), "Sample");
+    } else {
+        snprintf(policy, sizeof(policy), "Policy%u", ev->policy);
+    }
+
+    char category[32] = "";
+    if (ev->category != CATEGORY_NONE && ev->category < CATEGORY_COUNT) {
+        snprintf(category, sizeof(category), " (%s)", event_category_names[ev->category]);
+    }
+
+    printf("%s: [ I%u ]%s: Process comm: %.*s (PID: %d) RSS: %lldKB, Rate: %.2f KB/s%s%s\n",
+           time_str, ev->iteration, policy, EVENT_COMM_LEN, ev->comm, ev->pid,
+           (long long)ev->rss_kb, ev->rate, category,
+           (ev->flags & EVENT_FLAG_ALERT) ? " [mailed]" : "");
+}
+
+struct list_state {
+    const struct query *q;
+    long printed;
+};
+
+int list_callback(const struct event_record *ev, void *arg) {
+    struct list_state *state = arg;
+
+    if (!event_matches(ev, state->q)) {
+        return 1;
+    }
+    print_event(ev);
+    state->printed++;
+    return state->q->limit == 0 || state->printed < state->q->limit;
+}
+
+long list_events(const struct segment *segments, size_t count, const struct query *q) {
+    struct list_state state = { q, 0 };
+
+    for (size_t i = 0; i < count; i++) {
+        const struct segment_index *idx = &segments[i].idx;
+
+        if (!segment_may_match(idx, q)) {
+            continue;
+        }
+        if (q->policy >= 0 && !(idx->policy_mask & (1u << q->policy))) {
+            continue;
+        }
+        if (q->alerts_only && (q->policy >= 0 ? !(idx->alert_policy_mask & (1u << q->policy))
+                                              : idx->alert_policy_mask == 0)) {
+            continue;
+        }
+        if (q->breaches_only && idx->max_rss_kb <= q->upper_limit_kb) {
+            continue;
+        }
+        if (!scan_segment(q->dir, &segments[i], list_callback, &state)) {
+            break;
+        }
+    }
+    return state.printed;
+}
+
+uint64_t process_hash(int32_t pid, const char *comm) {
+    return ((uint64_t)event_comm_bit(comm) << 32) ^ ((uint64_t)(uint32_t)pid * 0x9e3779b97f4a7c15ull);
+}
+
+struct process_time *process_lookup(struct process_table *table, int32_t pid, const char *comm) {
+    if ((table->used + 1) * 2 > table->capacity) {
+        struct process_table grown = { NULL, table->capacity ? table->capacity * 2 : 1024, 0 };
+        grown.slots = calloc(grown.capacity, sizeof(*grown.slots));
+        if (grown.slots == NULL) {
+            fprintf(stderr, "Memory allocation failed\n");
+            exit(EXIT_FAILURE);
+        }
+        for (size_t i = 0; i < table->capacity; i++) {
+            if (table->slots[i].pid != 0) {
+                *process_lookup(&grown, table->slots[i].pid, table->slots[i].comm) = table->slots[i];
+            }
+        }
+        free(table->slots);
+        *table = grown;
+    }
+
+    size_t mask = table->capacity - 1;
+    size_t i = process_hash(pid, comm) & mask;
+    while (table->slots[i].pid != 0) {
+        if (table->slots[i].pid == pid && strncmp(table->slots[i].comm, comm, EVENT_COMM_LEN) == 0) {
+            return &table->slots[i];
+        }
+        i = (i + 1) & mask;
+    }
+
+    struct process_time *p = &table->slots[i];
+    p->pid = pid;
+    memcpy(p->comm, comm, EVENT_COMM_LEN);
+    table->used++;
+    return p;
+}
+
+// Returns 1 if any open above-limit interval can still be closed by a sample
+// from the iteration after the latest one seen
+int process_open_since(const struct process_table *table, uint32_t iteration) {
+    for (size_t i = 0; i < table->capacity; i++) {
+        const struct process_time *p = &table->slots[i];
+        if (p->pid != 0 && p->last_above && p->last_iteration + 1 >= iteration) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// Drops every open above-limit interval without crediting it
+void process_drop_open(struct process_table *table) {
+    for (size_t i = 0; i < table->capacity; i++) {
+        table->slots[i].last_above = 0;
+    }
+}
+
+struct top_state {
+    const struct query *q;
+    struct process_table table;
+    uint32_t last_iteration;    // iteration of the latest record scanned
+};
+
+int top_callback(const struct event_record *ev, void *arg) {
+    struct top_state *state = arg;
+    const struct query *q = state->q;
+
+    // The iteration counter going backwards means the monitor restarted, so
+    // nothing that was open before can be continued
+    if (ev->iteration < state->last_iteration) {
+        process_drop_open(&state->table);
+    }
+    state->last_iteration = ev->iteration;
+
+    // Only plain samples, so time is not counted again for every policy line
+    if (ev->policy != EVENT_POLICY_SAMPLE || ev->timestamp < q->since) {
+        return 1;
+    }
+    if (q->pid != 0 && ev->pid != q->pid) {
+        return 1;
+    }
+    if (q->comm != NULL && strncmp(ev->comm, q->comm, EVENT_COMM_LEN) != 0) {
+        return 1;
+    }
+
+    // Every process is sampled once per iteration, so the gap is only counted
+    // between samples of consecutive iterations. A missed iteration means the
+    // process exited or the monitor was down.
+    struct process_time *p = process_lookup(&state->table, ev->pid, ev->comm);
+    if (p->last_above && ev->iteration == p->last_iteration + 1 && ev->timestamp > p->last_ts) {
+        p->above_seconds += ev->timestamp - p->last_ts;
+    }
+    p->last_ts = ev->timestamp;
+    p->last_iteration = ev->iteration;
+    p->last_above = ev->rss_kb > q->upper_limit_kb;
+    if (ev->rss_kb > p->max_rss_kb) {
+        p->max_rss_kb = ev->rss_kb;
+    }
+    return 1;
+}
+
+int compare_process_time(const void *a, const void *b) {
+    const struct process_time *pa = a;
+    const struct process_time *pb = b;
+    if (pa->above_seconds != pb->above_seconds) {
+        return pa->above_seconds < pb->above_seconds ? 1 : -1;
+    }
+    return (pa->max_rss_kb < pb->max_rss_kb) - (pa->max_rss_kb > pb->max_rss_kb);
+}
+
+long top_processes(const struct segment *segments, size_t count, const struct query *q) {
+    struct top_state state = { q, { NULL, 0, 0 }, 0 };
+
+    for (size_t i = 0; i < count; i++) {
+        const struct segment_index *idx = &segments[i].idx;
+
+        if (!segment_may_match(idx, q)) {
+            continue;
+        }
+        // Nothing in this segment is above the limit, so it can only close
+        // intervals that are still open. Once the scan has moved two
+        // iterations past an interval it can never be credited, so if none
+        // are that recent the segment is skipped and open intervals dropped.
+        if (idx->max_rss_kb <= q->upper_limit_kb && !process_open_since(&state.table, state.last_iteration)) {
+            process_drop_open(&state.table);
+            continue;
+        }
+        scan_segment(q->dir, &segments[i], top_callback, &state);
+    }
+
+    // Compact the hash table in place and rank it
+    size_t n = 0;
+    for (size_t i = 0; i < state.table.capacity; i++) {
+        if (state.table.slots[i].pid != 0 && state.table.slots[i].above_seconds > 0) {
+            state.table.slots[n++] = state.table.slots[i];
+        }
+    }
+    qsort(state.table.slots, n, sizeof(*state.table.slots), compare_process_time);
+
+    long shown = 0;
+    for (size_t i = 0; i < n && shown < q->top; i++, shown++) {
+        const struct process_time *p = &state.table.slots[i];
+        printf("%2ld. Process comm: %.*s (PID: %d) above %ldKB for %lld seconds, max RSS: %lldKB\n",
+               shown + 1, EVENT_COMM_LEN, p->comm, p->pid, q->upper_limit_kb,
+               (long long)p->above_seconds, (long long)p->max_rss_kb);
+    }
+
+    free(state.table.slots);
+    return shown;
+}
+
+int main(int argc, char *argv[]) {
+    const char *config_file = "config.cfg";
+    const char *dir = NULL;
+    long value;
+    char comm[EVENT_COMM_LEN];
+    struct query q = { NULL, -1, 0, NULL, 0, 0, 0, 0, 0, 0 };
+    int opt;
+
+    while ((opt = getopt(argc, argv, "d:p:P:c:s:ban:t:f:h")) != -1) {
+        switch (opt) {
+        case 'd':
+            dir = optarg;
+            break;
+        case 'p':
+            if (!parse_number(optarg, &value) || value < 0 || value > EVENT_POLICY_MAX) {
+                fprintf(stderr, "Policy must be between 0 and %d\n", EVENT_POLICY_MAX);
+                exit(EXIT_FAILURE);
+            }
+            q.policy = (int)value;
+            break;
+        case 'P':
+            if (!parse_number(optarg, &value) || value <= 0 || value > INT32_MAX) {
+                fprintf(stderr, "PID must be a positive integer\n");
+                exit(EXIT_FAILURE);
+            }
+            q.pid = (int32_t)value;
+            break;
+        case 'c':
+            // ps, and so the store, keeps only the first 15 characters
+            snprintf(comm, sizeof(comm), "%s", optarg);
+            q.comm = comm;
+            break;
+        case 's': {
+            int64_t duration = parse_duration(optarg);
+            if (duration < 0) {
+                fprintf(stderr, "Invalid duration: %s\n", optarg);
+                exit(EXIT_FAILURE);
+            }
+            q.since = (int64_t)time(NULL) - duration;
+            break;
+        }
+        case 'b':
+            q.breaches_only = 1;
+            break;
+        case 'a':
+            q.alerts_only = 1;
+            break;
+        case 'n':
+            if (!parse_number(optarg, &value) || value <= 0) {
+                fprintf(stderr, "Limit must be a positive integer\n");
+                exit(EXIT_FAILURE);
+            }
+            q.limit = value;
+            break;
+        case 't':
+            if (!parse_number(optarg, &value) || value <= 0 || value > INT32_MAX) {
+                fprintf(stderr, "Top count must be a positive integer\n");
+                exit(EXIT_FAILURE);
+            }
+            q.top = (int)value;
+            break;
+        case 'f':
+            config_file = optarg;
+            break;
+        default:
+            usage(argv[0]);
+        }
+    }
+    if (optind != argc) {
+        usage(argv[0]);
+    }
+    // Top-N ranks plain samples, so event filters would be silently ignored
+    if (q.top > 0 && (q.policy >= 0 || q.breaches_only || q.alerts_only || q.limit > 0)) {
+        usage(argv[0]);
+    }
+
+    read_config(config_file);
+    q.dir = dir != NULL ? dir : store_dir;
+    q.upper_limit_kb = upper_limit_kb;
+
+    size_t count;
+    struct segment *segments = load_segments(q.dir, &count);
+
+    if (q.top > 0) {
+        top_processes(segments, count, &q);
+    } else {
+        list_events(segments, count, &q);
+    }
+
+    free(segments);
+    return 0;
+}
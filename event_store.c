@@ -0,0 +1,266 @@
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include "event_store.h"
+
+// Appends monitor events to a segmented event store.
+//
+// Build: gcc -o event_store event_store.c
+// Usage: ./event_store <store_dir> < events
+// One event per line, tab separated:
+//   timestamp iteration pid comm policy rss_kb rate category alert
+
+long segment_seconds = EVENT_SEGMENT_SECONDS_DEFAULT;
+
+void read_config(const char *file) {
+    FILE *fp = fopen(file, "r");
+    if (fp == NULL) {
+        return;  // Defaults are fine when run outside the monitor directory
+    }
+
+    char line[256];
+    while (fgets(line, sizeof(line), fp)) {
+        if (sscanf(line, "EVENT_SEGMENT_SECONDS=%ld", &segment_seconds) == 1) {
+            continue;
+        }
+    }
+
+    fclose(fp);
+
+    if (segment_seconds <= 0) {
+        fprintf(stderr, "Invalid EVENT_SEGMENT_SECONDS in config file. It must be a positive integer.\n");
+        exit(EXIT_FAILURE);
+    }
+}
+
+int parse_category(const char *name) {
+    for (int i = 1; i < CATEGORY_COUNT; i++) {
+        if (strcmp(name, event_category_names[i]) == 0) {
+            return i;
+        }
+    }
+    return CATEGORY_NONE;
+}
+
+// Splits a tab separated line in place, returns the number of fields found
+int split_fields(char *line, char **fields, int max_fields) {
+    int count = 0;
+    char *p = line;
+
+    while (count < max_fields) {
+        fields[count++] = p;
+        p = strchr(p, '\t');
+        if (p == NULL) {
+            break;
+        }
+        *p++ = '\0';
+    }
+    return count;
+}
+
+int parse_event(char *line, struct event_record *ev) {
+    char *fields[9] = { NULL };
+
+    line[strcspn(line, "\r\n")] = '\0';
+    if (line[0] == '\0') {
+        return 0;
+    }
+    if (split_fields(line, fields, 9) < 8) {
+        return 0;
+    }
+
+    memset(ev, 0, sizeof(*ev));
+    ev->timestamp = strtoll(fields[0], NULL, 10);
+    ev->iteration = (uint32_t)strtoul(fields[1], NULL, 10);
+    ev->pid = (int32_t)strtol(fields[2], NULL, 10);
+    strncpy(ev->comm, fields[3], EVENT_COMM_LEN - 1);
+    ev->policy = (uint8_t)atoi(fields[4]);
+    ev->rss_kb = strtoll(fields[5], NULL, 10);
+    ev->rate = strtod(fields[6], NULL);
+    ev->category = (uint8_t)parse_category(fields[7]);
+    if (fields[8] != NULL && atoi(fields[8]) != 0) {
+        ev->flags |= EVENT_FLAG_ALERT;
+    }
+
+    if (ev->timestamp <= 0 || ev->pid <= 0 || ev->policy > EVENT_POLICY_MAX) {
+        return 0;
+    }
+    return 1;
+}
+
+// Returns the id of the newest segment in dir, or -1 if there is none
+int64_t find_active_segment(const char *dir) {
+    DIR *dp = opendir(dir);
+    if (dp == NULL) {
+        fprintf(stderr, "Could not open event store %s: %s\n", dir, strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+
+    int64_t newest = -1;
+    struct dirent *entry;
+    while ((entry = readdir(dp)) != NULL) {
+        long long id;
+        char ext[8];
+        if (sscanf(entry->d_name, "seg-%lld.%7s", &id, ext) == 2 && strcmp(ext, "idx") == 0 && id > newest) {
+            newest = id;
+        }
+    }
+
+    closedir(dp);
+    return newest;
+}
+
+void save_index(const char *dir, int64_t id, const struct segment_index *idx) {
+    char path[4096];
+    char tmp_path[4096];
+
+    event_segment_path(path, sizeof(path), dir, id, "idx");
+    event_segment_path(tmp_path, sizeof(tmp_path), dir, id, "idx.tmp");
+
+    // Write to a temporary file and rename so readers never see a torn index
+    FILE *fp = fopen(tmp_path, "wb");
+    if (fp == NULL || fwrite(idx, sizeof(*idx), 1, fp) != 1 || fclose(fp) != 0) {
+        fprintf(stderr, "Could not write segment index %s\n", tmp_path);
+        exit(EXIT_FAILURE);
+    }
+    if (rename(tmp_path, path) != 0) {
+        fprintf(stderr, "Could not rename segment index %s: %s\n", tmp_path, strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+}
+
+int load_index(const char *dir, int64_t id, struct segment_index *idx) {
+    char path[4096];
+
+    event_segment_path(path, sizeof(path), dir, id, "idx");
+    FILE *fp = fopen(path, "rb");
+    if (fp == NULL) {
+        return 0;
+    }
+    int ok = fread(idx, sizeof(*idx), 1, fp) == 1;
+    fclose(fp);
+
+    return ok && idx->magic == EVENT_STORE_MAGIC && idx->version == EVENT_STORE_VERSION;
+}
+
+FILE *open_segment_data(const char *dir, int64_t id, const struct segment_index *idx) {
+    char path[4096];
+
+    event_segment_path(path, sizeof(path), dir, id, "dat");
+
+    // Drop records appended after the last index update (e.g. the writer was
+    // killed between the two), so the index always describes the whole file
+    if (truncate(path, (off_t)(idx->count * sizeof(struct event_record))) != 0 && errno != ENOENT) {
+        fprintf(stderr, "Could not truncate segment %s: %s\n", path, strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+
+    FILE *fp = fopen(path, "ab");
+    if (fp == NULL) {
+        fprintf(stderr, "Could not open segment %s: %s\n", path, strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+    return fp;
+}
+
+void new_index(struct segment_index *idx, int64_t first_ts) {
+    memset(idx, 0, sizeof(*idx));
+    idx->magic = EVENT_STORE_MAGIC;
+    idx->version = EVENT_STORE_VERSION;
+    idx->first_ts = first_ts;
+    idx->last_ts = first_ts;
+}
+
+void index_event(struct segment_index *idx, const struct event_record *ev) {
+    if (ev->timestamp < idx->first_ts) {
+        idx->first_ts = ev->timestamp;
+    }
+    if (ev->timestamp > idx->last_ts) {
+        idx->last_ts = ev->timestamp;
+    }
+    if (ev->rss_kb > idx->max_rss_kb) {
+        idx->max_rss_kb = ev->rss_kb;
+    }
+    idx->policy_mask |= 1u << ev->policy;
+    if (ev->flags & EVENT_FLAG_ALERT) {
+        idx->alert_policy_mask |= 1u << ev->policy;
+    }
+    idx->category_mask |= 1u << ev->category;
+    event_filter_set(idx->pid_filter, event_pid_bit(ev->pid));
+    event_filter_set(idx->comm_filter, event_comm_bit(ev->comm));
+    idx->count++;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc != 2) {
+        fprintf(stderr, "Usage: %s <store_dir> < events\n", argv[0]);
+        exit(EXIT_FAILURE);
+    }
+
+    const char *dir = argv[1];
+    read_config("config.cfg");
+
+    if (mkdir(dir, 0755) != 0 && errno != EEXIST) {
+        fprintf(stderr, "Could not create event store %s: %s\n", dir, strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+
+    struct segment_index idx;
+    int64_t id = find_active_segment(dir);
+    FILE *data_fp = NULL;
+
+    if (id >= 0 && load_index(dir, id, &idx)) {
+        data_fp = open_segment_data(dir, id, &idx);
+    }
+
+    char line[512];
+    struct event_record ev;
+    long written = 0;
+
+    while (fgets(line, sizeof(line), stdin)) {
+        if (!parse_event(line, &ev)) {
+            continue;
+        }
+
+        // Roll over to a new segment once the active one spans too long or is full
+        if (data_fp != NULL &&
+            (ev.timestamp - idx.first_ts >= segment_seconds || idx.count >= EVENT_SEGMENT_MAX_RECORDS)) {
+            fclose(data_fp);
+            save_index(dir, id, &idx);
+            data_fp = NULL;
+        }
+
+        if (data_fp == NULL) {
+            id = ev.timestamp > id ? ev.timestamp : id + 1;
+            new_index(&idx, ev.timestamp);
+            data_fp = open_segment_data(dir, id, &idx);
+        }
+
+        if (fwrite(&ev, sizeof(ev), 1, data_fp) != 1) {
+            fprintf(stderr, "Could not append event: %s\n", strerror(errno));
+            exit(EXIT_FAILURE);
+        }
+        index_event(&idx, &ev);
+        written++;
+    }
+
+    if (data_fp != NULL) {
+        if (fclose(data_fp) != 0) {
+            fprintf(stderr, "Could not flush segment: %s\n", strerror(errno));
+            exit(EXIT_FAILURE);
+        }
+        if (written > 0) {
+            save_index(dir, id, &idx);
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,115 @@
+#ifndef EVENT_STORE_H
+#define EVENT_STORE_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+// Layout shared by event_store (writer) and event_query (reader).
+//
+// A store is a directory of segments. Each segment is a pair of files:
+//   seg-<id>.dat  append-only array of struct event_record
+//   seg-<id>.idx  one struct segment_index summarising the .dat file
+// The id is the timestamp of the segment's first event, or the previous
+// id + 1 if that would not be larger. Ids only order the segments; the
+// real time range is first_ts/last_ts in the index.
+// The index holds the time range, highest RSS, the policies/categories seen
+// and small bitmaps of the PIDs and comms in the segment, so the query tool
+// can skip a whole segment without reading its records.
+
+#define EVENT_STORE_MAGIC 0x4d4d4556u   // "MMEV"
+#define EVENT_STORE_VERSION 1
+
+#define EVENT_COMM_LEN 16               // ps comm is at most 15 characters
+#define EVENT_FILTER_WORDS 64           // 64 * 64 = 4096 bits per filter
+#define EVENT_SEGMENT_MAX_RECORDS 262144
+#define EVENT_SEGMENT_SECONDS_DEFAULT 3600
+
+#define EVENT_POLICY_SAMPLE 0           // plain per-iteration RSS sample
+#define EVENT_POLICY_MAX 7
+
+#define EVENT_FLAG_ALERT 0x01           // event was added to the alert email
+
+enum event_category {
+    CATEGORY_NONE = 0,
+    CATEGORY_GRADUAL_INCREASE,
+    CATEGORY_GRADUAL_DECREASE,
+    CATEGORY_STEEP_INCREASE,
+    CATEGORY_STEEP_DECREASE,
+    CATEGORY_EXPONENTIAL_INCREASE,
+    CATEGORY_EXPONENTIAL_DECREASE,
+    CATEGORY_SUDDEN_INCREASE,
+    CATEGORY_SUDDEN_DECREASE,
+    CATEGORY_COUNT
+};
+
+// Same wording as categorize_rate() in memorymoniter_final.sh
+static const char *const event_category_names[CATEGORY_COUNT] = {
+    "",
+    "gradual increase",
+    "gradual decrease",
+    "steep increase",
+    "steep decrease",
+    "exponential increase",
+    "exponential decrease",
+    "sudden increase",
+    "sudden decrease",
+};
+
+struct event_record {
+    int64_t timestamp;                  // seconds since the epoch
+    int64_t rss_kb;
+    double rate;                        // KB/s
+    uint32_t iteration;
+    int32_t pid;
+    uint8_t policy;                     // EVENT_POLICY_SAMPLE or 1..EVENT_POLICY_MAX
+    uint8_t category;                   // enum event_category
+    uint8_t flags;                      // EVENT_FLAG_*
+    uint8_t reserved;
+    char comm[EVENT_COMM_LEN];
+    uint32_t reserved2;
+};
+
+struct segment_index {
+    uint32_t magic;
+    uint32_t version;
+    int64_t first_ts;
+    int64_t last_ts;
+    uint64_t count;                     // records in the .dat file covered by this index
+    int64_t max_rss_kb;
+    uint32_t policy_mask;               // bit n set if policy n occurs
+    uint32_t alert_policy_mask;         // bit n set if policy n raised an alert
+    uint32_t category_mask;
+    uint32_t reserved;
+    uint64_t pid_filter[EVENT_FILTER_WORDS];
+    uint64_t comm_filter[EVENT_FILTER_WORDS];
+};
+
+_Static_assert(sizeof(struct event_record) == 56, "event_record layout changed");
+
+static inline uint32_t event_pid_bit(int32_t pid) {
+    return (uint32_t)(((uint64_t)(uint32_t)pid * 0x9e3779b97f4a7c15ull) >> 52);
+}
+
+static inline uint32_t event_comm_bit(const char *comm) {
+    uint64_t hash = 0xcbf29ce484222325ull;   // FNV-1a
+    for (int i = 0; i < EVENT_COMM_LEN && comm[i] != '\0'; i++) {
+        hash ^= (unsigned char)comm[i];
+        hash *= 0x100000001b3ull;
+    }
+    return (uint32_t)(hash >> 52);
+}
+
+static inline void event_filter_set(uint64_t *filter, uint32_t bit) {
+    filter[bit / 64] |= 1ull << (bit % 64);
+}
+
+static inline int event_filter_test(const uint64_t *filter, uint32_t bit) {
+    return (filter[bit / 64] >> (bit % 64)) & 1;
+}
+
+static inline void event_segment_path(char *buf, size_t size, const char *dir, int64_t id, const char *ext) {
+    snprintf(buf, size, "%s/seg-%010lld.%s", dir, (long long)id, ext);
+}
+
+#endif
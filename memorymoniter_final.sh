@@ -25,6 +25,29 @@ log_details() {
     echo "$(date +"%a %b %d %T %Z %Y"): $message" >> "$LOG_FILE"
 }
 
+EVENT_STORE="./event_store"
+event_batch=""
+event_store_warned=0
+
+# Function to queue a structured event for the event store
+# Usage: record_event <policy> <pid> <comm> <rss> <rate> <category> [alert]
+record_event() {
+    local now
+    printf -v now '%(%s)T' -1  # bash builtin, avoids forking date per event
+    event_batch+="$now"$'\t'"$iteration_counter"$'\t'"$2"$'\t'"$3"$'\t'"$1"$'\t'"$4"$'\t'"$5"$'\t'"$6"$'\t'"${7:-0}"$'\n'
+}
+
+# Function to write the queued events in one batch
+flush_events() {
+    if [[ -n "$event_batch" && -x "$EVENT_STORE" ]]; then
+        printf '%s' "$event_batch" | "$EVENT_STORE" "${EVENT_STORE_DIR:-events}"
+    elif [[ -n "$event_batch" && $event_store_warned -eq 0 ]]; then
+        log_details "$EVENT_STORE not found, events are not being stored. Build it with: gcc -o event_store event_store.c && gcc -o event_query event_query.c"
+        event_store_warned=1
+    fi
+    event_batch=""
+}
+
 # Function to get RSS memory usage of each process in KB
 get_process_memory_usage() {
     ps -u $(whoami) -eo pid,comm,rss --sort=-rss | awk '$3 ~ /^[0-9]+$/ && ($2 ~ /^-bash$/ || $2 ~ /^\/bin\/bash$/ || $2 ~ /^bash$/ || $2 ~ /^sh$/ || $2 ~ /^sleep$/ || $2 ~ /^\.\/.*$/ || $2 ~ /^policy.*/ || $2 ~ /^.*\.sh$/)'
@@ -97,6 +120,9 @@ while true; do
 
             # Log rate of change
             log_details "[ I$iteration_counter ]Process comm: $comm (PID: $pid) has a $rate_category change in memory usage. Rate: ${rate_of_change}KB/s, RSS: ${rss}KB"
+            record_event 0 "$pid" "$comm" "$rss" "$rate_of_change" "$rate_category"
+        else
+            record_event 0 "$pid" "$comm" "$rss" 0 ""
         fi
 
         # Update previous values
@@ -107,6 +133,7 @@ while true; do
         if [[ $rss -gt $UPPER_LIMIT ]]; then
             # Log initial detection
             log_details "[ I$iteration_counter ]Policy1: Process (PID: $pid), command: $comm - memory usage crossed upper limit: ${rss}KB"
+            record_event 1 "$pid" "$comm" "$rss" "$rate_of_change" "$rate_category"
 
             # Wait for the specified wait time
             sleep $WAIT_TIME
@@ -120,6 +147,7 @@ while true; do
 
                 log_details "[ I$iteration_counter ]Policy1: Process comm: $comm (PID: $pid) increasing: ${new_rss} KB, Rate: $rate_of_change KB/s ($rate_category)"
                 email_message+="[ I$iteration_counter ]Policy1: Process comm: $comm (PID: $pid) memory usage has crossed the upper limit and is increasing. Current usage: ${new_rss}KB, Rate: $rate_of_change KB/s ($rate_category)"$'\n'
+                record_event 1 "$pid" "$comm" "$new_rss" "$rate_of_change" "$rate_category" 1
                 log_details "[ I$iteration_counter ]Sent Mail --- Policy1 Violation for process (PID: $pid)"
             fi
         fi
@@ -139,6 +167,7 @@ while true; do
             last_breach_time=$current_time
 
             log_details "[ I$iteration_counter ]Policy2 Frequent Memory Breach Alert: Process comm: $comm (PID: $pid) frequently breaching the upper memory limit. Breached $breach_count times in the last $TIME_FRAME seconds. Rate: $rate_of_change KB/s ($rate_category)\n"
+            policy2_alert=0
 
             # Check if breaches are too frequent
             if [[ $breach_count -gt $FREQUENCY_THRESHOLD ]]; then
@@ -146,10 +175,12 @@ while true; do
                 rate_category=$(categorize_rate $rate_of_change)
 
                 email_message+="[ I$iteration_counter ]Policy2 Frequent Memory Breach Alert: Process comm: $comm (PID: $pid) frequently breaching the upper memory limit. Breached $breach_count times in the last $TIME_FRAME seconds. Rate: $rate_of_change KB/s ($rate_category)"$'\n'
+                policy2_alert=1
                 breach_count=0  # Reset the count after sending alert
                 log_details "[ I$iteration_counter ]Sent Mail: Policy2 Frequent Memory Breach Alert: Process comm: $comm (PID: $pid) frequently breaching the upper memory limit."
                 #log_details "[ I$iteration_counter ]Sent Mail --- Policy2 Violation for process (PID: $pid)"
             fi
+            record_event 2 "$pid" "$comm" "$rss" "$rate_of_change" "$rate_category" "$policy2_alert"
         fi
 
         # Check if memory usage returns below the lower limit for Policy 2
@@ -158,6 +189,7 @@ while true; do
             rate_category=$(categorize_rate $rate_of_change)
 
             log_details "[ I$iteration_counter ]Policy2: Process (PID: $pid) comm: $comm memory usage returned to normal: ${rss}KB, Rate: $rate_of_change KB/s ($rate_category)"
+            record_event 2 "$pid" "$comm" "$rss" "$rate_of_change" "$rate_category"
         fi
 
         # Check for gradual decline below lower limit for Policy 3
@@ -175,6 +207,7 @@ while true; do
                     rate_category=$(categorize_rate $rate_of_change)
                     log_details "[ I$iteration_counter ]Policy3: Process (PID: $pid) comm: $comm  memory usage has been gradually declining below lower limit for $TIME_FRAME seconds: ${rss}KB, Rate: $rate_of_change KB/s ($rate_category)"
                     email_message+="[ I$iteration_counter ]Policy3: Process (PID: $pid) comm: $comm  memory usage has been gradually declining below lower limit for $TIME_FRAME seconds: ${rss}KB, Rate: $rate_of_change KB/s ($rate_category)"$'\n'
+                    record_event 3 "$pid" "$comm" "$rss" "$rate_of_change" "$rate_category" 1
                    # log_details "[ I$iteration_counter ]Sent Mail --- Policy3 Violation for process (PID: $pid)"
                     unset policy3_start_times[$pid]
                 fi
@@ -198,6 +231,7 @@ while true; do
                     rate_category=$(categorize_rate $rate_of_change)
                     log_details "[ I$iteration_counter ]Policy4: Process (PID: $pid) comm: $comm memory usage consistently near upper limit for $TIME_FRAME seconds: ${rss}KB, Rate: $rate_of_change KB/s ($rate_category)"
                     email_message+="[ I$iteration_counter ]Policy4: Process (PID: $pid) comm: $comm  memory usage consistently near upper limit for $TIME_FRAME seconds: ${rss}KB, Rate: $rate_of_change KB/s ($rate_category)"$'\n'
+                    record_event 4 "$pid" "$comm" "$rss" "$rate_of_change" "$rate_category" 1
                     #log_details "[ I$iteration_counter ]Sent Mail --- Policy4 Violation for process (PID: $pid)"
                     unset policy4_tracking[$pid]
                 fi
@@ -223,10 +257,12 @@ while true; do
                 if [[ $new_rss -gt $rss ]]; then
                     log_details "[ I$iteration_counter ]Policy5: Process comm: $comm (PID: $pid) memory usage increasing after constant period: ${new_rss}KB, Rate: $rate_of_change KB/s ($rate_category)"
                     email_message+="[ I$iteration_counter ]Policy5: Process comm: $comm (PID: $pid) memory usage increasing after constant period. New usage: ${new_rss}KB, Rate: $rate_of_change KB/s ($rate_category)"$'\n'
+                    record_event 5 "$pid" "$comm" "$new_rss" "$rate_of_change" "$rate_category" 1
                     #log_details "[ I$iteration_counter ]Sent Mail --- Policy5 Violation for process (PID: $pid)"                   
                     policy5_tracking[$pid]=$current_time # Reset tracking for continuous increase
                 else
                     log_details "[ I$iteration_counter ]Policy5: Process comm: $comm (PID: $pid) memory usage did not increase: ${new_rss}KB, Rate: $rate_of_change KB/s ($rate_category)"
+                    record_event 5 "$pid" "$comm" "$new_rss" "$rate_of_change" "$rate_category"
                 fi
             fi
         else
@@ -239,14 +275,17 @@ while true; do
             irregular_pattern=true
             sudden_breach=$((sudden_breach + 1))
             log_details "[ I$iteration_counter ]Policy6: Sudden increase detected for process comm: $comm (PID: $pid). Rate: ${rate_of_change}KB/s, ($rate_category)"
+            record_event 6 "$pid" "$comm" "$rss" "$rate_of_change" "$rate_category"
         elif (( $(echo "$rate_of_change < -$SUDDEN_THRESHOLD" | bc 2>/dev/null) )) && [[ $rss -gt $UPPER_LIMIT ]]; then
             irregular_pattern=true
             sudden_breach=$((sudden_breach + 1))
             log_details "[ I$iteration_counter ]Policy6: Sudden decrease detected for process comm: $comm (PID: $pid). Rate: ${rate_of_change}KB/s, ($rate_category)"
+            record_event 6 "$pid" "$comm" "$rss" "$rate_of_change" "$rate_category"
         fi
 
         if (( irregular_pattern && $sudden_breach > 5 )); then
             email_message+="[ I$iteration_counter ]Policy6: Irregular memory usage detected for process comm: $comm (PID: $pid). Rate: ${rate_of_change}KB/s, ($rate_category)"$'\n'
+            record_event 6 "$pid" "$comm" "$rss" "$rate_of_change" "$rate_category" 1
            # log_details "[ I$iteration_counter ]Sent Mail --- Policy6 Violation for process (PID: $pid)"       
         fi
 
@@ -255,6 +294,7 @@ while true; do
             if [[ -z ${policy7_tracking[$pid]} ]]; then
                 policy7_tracking[$pid]=$current_time
                 log_details "[ I$iteration_counter ]Policy7: Process (PID: $pid), command: $comm - memory usage crossed upper limit: ${rss}KB"
+                record_event 7 "$pid" "$comm" "$rss" "$rate_of_change" "$rate_category"
             else
                 start_time=${policy7_tracking[$pid]}
                 elapsed_time=$((current_time - start_time))
@@ -271,10 +311,12 @@ while true; do
                     if [[ $new_rss -lt $rss ]]; then
                         log_details "[ I$iteration_counter ]Policy7: Process comm: $comm (PID: $pid) memory usage decreasing after constant period: ${new_rss}KB, Rate: $rate_of_change KB/s ($rate_category)"
                         email_message+="[ I$iteration_counter ]Policy7: Process comm: $comm (PID: $pid) memory usage decreasing after constant period. New usage: ${new_rss}KB, Rate: $rate_of_change KB/s ($rate_category)"$'\n'
+                        record_event 7 "$pid" "$comm" "$new_rss" "$rate_of_change" "$rate_category" 1
                         #log_details "[ I$iteration_counter ]Sent Mail --- Policy7 Violation for process (PID: $pid)"
                         policy7_tracking[$pid]=$current_time # Reset tracking for continuous decrease
                     else
                         log_details "[ I$iteration_counter ]Policy7: Process comm: $comm (PID: $pid) memory usage did not decrease: ${new_rss}KB, Rate: $rate_of_change KB/s ($rate_category)"
+                        record_event 7 "$pid" "$comm" "$new_rss" "$rate_of_change" "$rate_category"
                     fi
                 fi
             fi
@@ -284,6 +326,9 @@ while true; do
 
     done < <(get_process_memory_usage)
 
+    # Write this iteration's events to the event store
+    flush_events
+
     counter=$((counter + 1))
     iteration_counter=$((iteration_counter+1))
 